@@ -0,0 +1,117 @@
+#include <sstream>
+#include "Aliases.h"
+
+using namespace std;
+
+AliasTable::Tokens AliasTable::tokenize(const std::string& text) {
+    Tokens tokens;
+    istringstream iss(text);
+    for (string word; iss >> word; ) {
+        tokens.push_back(word);
+    }
+    return tokens;
+}
+
+void AliasTable::defineAlias(const std::string& name, const std::string& value) {
+    Alias alias;
+    alias.value = value;
+    alias.tokens = tokenize(value);
+    _aliases[name] = alias;
+    _expanded.clear();
+}
+
+bool AliasTable::removeAlias(const std::string& name) {
+    if (!_aliases.erase(name)) {
+        return false;
+    }
+    _expanded.clear();
+    return true;
+}
+
+std::map<std::string, std::string> AliasTable::aliases() const {
+    map<string, string> ret;
+    for (const auto& alias : _aliases) {
+        ret[alias.first] = alias.second.value;
+    }
+    return ret;
+}
+
+void AliasTable::defineFunction(const std::string& name, const std::string& body) {
+    Function function;
+    function.body = body;
+    size_t start = 0;
+    while (start <= body.size()) {
+        size_t end = body.find(';', start);
+        if (end == string::npos) {
+            end = body.size();
+        }
+        Statement statement;
+        statement.text = body.substr(start, end - start);
+        size_t first = statement.text.find_first_not_of(" \t");
+        if (first != string::npos) {
+            statement.text = statement.text.substr(first, statement.text.find_last_not_of(" \t") + 1 - first);
+            // the & is not a word of the command, only a mark on its text
+            statement.background = statement.text[statement.text.size() - 1] == '&';
+            statement.tokens = tokenize(statement.text.substr(0, statement.text.size() - statement.background));
+            if (!statement.tokens.empty()) {
+                function.statements.push_back(statement);
+            }
+        }
+        start = end + 1;
+    }
+    _functions[name] = function;
+}
+
+const AliasTable::Function *AliasTable::function(const std::string& name) const {
+    auto it = _functions.find(name);
+    return it == _functions.end() ? nullptr : &it->second;
+}
+
+bool AliasTable::resolve(const std::string& name, Tokens& tokens) const {
+    set<string> seen;
+    string current = name;
+    tokens = _aliases.find(name)->second.tokens;
+    seen.insert(name);
+    while (!tokens.empty() && tokens[0] != current) {
+        auto it = _aliases.find(tokens[0]);
+        if (it == _aliases.end()) {
+            break;
+        }
+        if (!seen.insert(tokens[0]).second) {
+            return false;
+        }
+        current = tokens[0];
+        Tokens next = it->second.tokens;
+        next.insert(next.end(), tokens.begin() + 1, tokens.end());
+        tokens.swap(next);
+    }
+    return true;
+}
+
+bool AliasTable::expand(Tokens& argv, size_t& spliced) {
+    spliced = 0;
+    if (argv.empty() || _aliases.find(argv[0]) == _aliases.end()) {
+        return true;
+    }
+    auto it = _expanded.find(argv[0]);
+    if (it == _expanded.end()) {
+        Tokens tokens;
+        if (!resolve(argv[0], tokens)) {
+            return false;
+        }
+        it = _expanded.insert(make_pair(argv[0], tokens)).first;
+    }
+    const Tokens& tokens = it->second;
+    spliced = tokens.size();
+    argv.erase(argv.begin());
+    argv.insert(argv.begin(), tokens.begin(), tokens.end());
+    return true;
+}
+
+bool AliasTable::enterFunction(const std::string& name) {
+    return _running.insert(name).second;
+}
+
+void AliasTable::leaveFunction(const std::string& name) {
+    _running.erase(name);
+}
@@ -0,0 +1,63 @@
+#ifndef SMASH_ALIASES_H_
+#define SMASH_ALIASES_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+// Alias and function definitions. Both are tokenized once when they are
+// defined; a call only splices the stored tokens into its argv.
+class AliasTable {
+public:
+    typedef std::vector<std::string> Tokens;
+    struct Statement {
+        // as written, including a trailing &
+        std::string text;
+        Tokens tokens;
+        bool background;
+    };
+    struct Function {
+        std::string body;
+        std::vector<Statement> statements;
+    };
+
+    AliasTable() {}
+    AliasTable(const AliasTable&) = delete;
+    void operator=(const AliasTable&) = delete;
+
+    void defineAlias(const std::string& name, const std::string& value);
+    bool removeAlias(const std::string& name);
+    // name -> value as it was defined
+    std::map<std::string, std::string> aliases() const;
+    void defineFunction(const std::string& name, const std::string& body);
+    const Function *function(const std::string& name) const;
+
+    // Replaces an alias in argv[0] by its (fully expanded) tokens and sets
+    // spliced to how many leading words came from aliases. An alias whose
+    // value starts with its own name stops there, as in `alias ls=ls -l`;
+    // any longer cycle is a recursion and makes expand() return false.
+    bool expand(Tokens& argv, size_t& spliced);
+
+    // false if the function is already running, i.e. the call would recurse
+    bool enterFunction(const std::string& name);
+    void leaveFunction(const std::string& name);
+
+    static Tokens tokenize(const std::string& text);
+
+private:
+    struct Alias {
+        std::string value;
+        Tokens tokens;
+    };
+    bool resolve(const std::string& name, Tokens& tokens) const;
+
+    std::map<std::string, Alias> _aliases;
+    std::map<std::string, Function> _functions;
+    // resolved alias chains; dropped whenever an alias definition changes
+    std::unordered_map<std::string, Tokens> _expanded;
+    std::set<std::string> _running;
+};
+
+#endif //SMASH_ALIASES_H_
@@ -6,7 +6,19 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include <iomanip>
+#include <stdio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <chrono>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <fstream>
 #include "Commands.h"
+#include "Glob.h"
+#include "OutputRing.h"
+#include "Snapshot.h"
 
 using namespace std;
 const std::string WHITESPACE = " \n\r\t\f\v";
@@ -48,15 +60,30 @@ string _trim(const std::string& s)
   return _rtrim(_ltrim(s));
 }
 
+void _expandWord(const std::string& word, std::vector<std::string>& words) {
+  // a pattern that matches nothing is passed on literally
+  if (!hasGlobChars(word) || globExpand(word, words) == 0) {
+    words.push_back(globUnescape(word));
+  }
+}
+
 int _parseCommandLine(const char* cmd_line, char** args) {
 //   FUNC_ENTRY()
   int i = 0;
+  args[0] = NULL;
   std::istringstream iss(_trim(string(cmd_line)).c_str());
   for(std::string s; iss >> s; ) {
-    args[i] = (char*)malloc(s.length()+1);
-    memset(args[i], 0, s.length()+1);
-    strcpy(args[i], s.c_str());
-    args[++i] = NULL;
+    std::vector<std::string> words;
+    _expandWord(s, words);
+    for (const std::string& word : words) {
+      if (i == COMMAND_MAX_ARGS) {
+        throw Command::CommandError("too many arguments");
+      }
+      args[i] = (char*)malloc(word.length()+1);
+      memset(args[i], 0, word.length()+1);
+      strcpy(args[i], word.c_str());
+      args[++i] = NULL;
+    }
   }
   return i;
 }
@@ -84,12 +111,119 @@ void _removeBackgroundSign(char* cmd_line) {
   cmd_line[str.find_last_not_of(WHITESPACE, idx) + 1] = 0;
 }
 
+// Recognizes `name() { cmd; cmd; }` and returns the name and the body.
+bool _parseFunctionDefinition(const char* cmd_line, string& name, string& body) {
+  string line = _trim(cmd_line);
+  size_t i = 0;
+  while (i < line.size() && (isalnum(line[i]) || line[i] == '_' || line[i] == '-')) {
+    ++i;
+  }
+  if (i == 0 || isdigit(line[0])) {
+    return false;
+  }
+  name = line.substr(0, i);
+  string rest = _ltrim(line.substr(i));
+  if (rest.compare(0, 2, "()") != 0) {
+    return false;
+  }
+  rest = _ltrim(rest.substr(2));
+  if (rest.size() < 2 || rest[0] != '{' || rest[rest.size() - 1] != '}') {
+    return false;
+  }
+  body = _trim(rest.substr(1, rest.size() - 2));
+  return true;
+}
+
+// Splits `alias name=value` into name and value; value may be quoted.
+bool _parseAliasDefinition(const char* cmd_line, string& name, string& value) {
+  string line = _trim(cmd_line);
+  size_t start = line.find_first_of(WHITESPACE);
+  if (start == string::npos) {
+    return false;
+  }
+  line = _ltrim(line.substr(start));
+  size_t eq = line.find('=');
+  if (eq == string::npos || eq == 0 || line.find_first_of(WHITESPACE) < eq) {
+    return false;
+  }
+  name = line.substr(0, eq);
+  value = _trim(line.substr(eq + 1));
+  if (value.size() >= 2 && (value[0] == '\'' || value[0] == '"') && value[value.size() - 1] == value[0]) {
+    value = value.substr(1, value.size() - 2);
+  }
+  return !AliasTable::tokenize(value).empty();
+}
+
+// splits NAME=VALUE; false if NAME is not a valid variable name
+bool _splitAssignment(const char* word, string& name, string& value) {
+  const char *eq = strchr(word, '=');
+  if (!eq || eq == word || isdigit(word[0])) {
+    return false;
+  }
+  for (const char *c = word; c < eq; ++c) {
+    if (!isalnum(*c) && *c != '_') {
+      return false;
+    }
+  }
+  name.assign(word, eq);
+  value.assign(eq + 1);
+  return true;
+}
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+#ifndef PIDFD_SIGNAL_PROCESS_GROUP
+#define PIDFD_SIGNAL_PROCESS_GROUP (1UL << 2)
+#endif
+
+int _pidfdOpen(pid_t pid) {
+  return syscall(SYS_pidfd_open, pid, 0);
+}
+
+int _pidfdSendSignal(int pidfd, int sig, unsigned int flags) {
+  return syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, flags);
+}
+
+// true if smash runs in the foreground of a terminal it reads from
+bool _ownsTerminal() {
+  return isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+}
+
+// Blocks a signal for as long as it lives and restores the old mask when
+// the scope is left, however it is left.
+class SignalBlock {
+    sigset_t _orig;
+public:
+    SignalBlock(int sig) {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, sig);
+        sigprocmask(SIG_BLOCK, &set, &_orig);
+    }
+    ~SignalBlock() {
+        sigprocmask(SIG_SETMASK, &_orig, nullptr);
+    }
+    // the mask from before the block, for ppoll to wait with
+    const sigset_t *orig() const {
+        return &_orig;
+    }
+};
+
 /* -------------- Command -------------- */
 
 Command::Command(const char* cmd_line) {
     _smash = &SmallShell::getInstance();
-    _cmd_line = new char[COMMAND_ARGS_MAX_LENGTH];
+    _cmd_line = new char[strlen(cmd_line) + 1];
     strcpy(_cmd_line, cmd_line);
+    _pidfd = -1;
+}
+
+Command::~Command() {
+    delete[] _cmd_line;
 }
 
 const char *Command::cmd_line() {
@@ -100,6 +234,45 @@ int Command::pid() {
     return _pid;
 }
 
+int Command::pidfd() {
+    return _pidfd;
+}
+
+int Command::sendSignal(int sig, bool group) {
+    if (_pidfd < 0) {
+        return group ? killpg(_pid, sig) : kill(_pid, sig);
+    }
+    if (!group) {
+        return _pidfdSendSignal(_pidfd, sig, 0);
+    }
+    int ret = _pidfdSendSignal(_pidfd, sig, PIDFD_SIGNAL_PROCESS_GROUP);
+    if (ret < 0 && errno == EINVAL) {
+        // kernels before 6.9 can't signal a group through a pidfd
+        ret = killpg(_pid, sig);
+    }
+    return ret;
+}
+
+int Command::wait(int options) {
+    if (_pidfd < 0) {
+        int ret = waitpid(_pid, nullptr, (options & WSTOPPED ? WUNTRACED : 0) | (options & WNOHANG));
+        return ret < 0 ? -1 : ret > 0;
+    }
+    siginfo_t info;
+    info.si_pid = 0;
+    if (waitid(P_PIDFD, _pidfd, &info, options) < 0) {
+        return -1;
+    }
+    if (info.si_pid == 0) {
+        return 0;
+    }
+    if (info.si_code == CLD_EXITED || info.si_code == CLD_KILLED || info.si_code == CLD_DUMPED) {
+        close(_pidfd);
+        _pidfd = -1;
+    }
+    return 1;
+}
+
 /* -------------- Command::CommandError -------------- */
 
 Command::CommandError::CommandError(const std::string& message) {
@@ -116,6 +289,144 @@ SmallShell::SmallShell():
     _cwd = new char[COMMAND_ARGS_MAX_LENGTH];
     _cd_called = false;
     _running_cmd = nullptr;
+    _interrupted = 0;
+    loadRc();
+}
+
+// Folds one rc line into the state it leaves behind: chprompt, export,
+// joblog -c/-m, aliases and functions. Words are not globbed here, since
+// the snapshot outlives the cwd it was built in; a line that would glob
+// is left to run as a command.
+static bool _compileRcState(const string& line, RcState& state) {
+    if (_isBackgroundComamnd(line.c_str())) {
+        return false;
+    }
+    string name, value;
+    if (_parseFunctionDefinition(line.c_str(), name, value)) {
+        state.set(RcState::RC_FUNCTION, name, value);
+        return true;
+    }
+    AliasTable::Tokens args = AliasTable::tokenize(line);
+    if (args.empty() || args.size() > COMMAND_MAX_ARGS) {
+        return false;
+    }
+    const string& cmd = args[0];
+    if (cmd == "alias") {
+        // the value is globbed when the alias is used, not here
+        if (!_parseAliasDefinition(line.c_str(), name, value)) {
+            return false;
+        }
+        state.set(RcState::RC_ALIAS, name, value);
+        return true;
+    }
+    for (string& arg : args) {
+        if (hasGlobChars(arg)) {
+            return false;
+        }
+        arg = globUnescape(arg);
+    }
+    if (cmd == "chprompt") {
+        state.set(RcState::RC_PROMPT, "", (args.size() > 1 ? args[1] : "smash") + "> ");
+        return true;
+    }
+    if (cmd == "joblog" && args.size() == 3) {
+        if (args[1] == "-c" && (args[2] == "on" || args[2] == "off")) {
+            state.set(RcState::RC_CAPTURE, "", args[2]);
+            return true;
+        }
+        if (args[1] == "-m" && args[2].find_first_not_of("0123456789") == string::npos) {
+            state.set(RcState::RC_CAPTURE_LIMIT, "", args[2]);
+            return true;
+        }
+        return false;
+    }
+    if (cmd == "export" && args.size() > 1) {
+        std::vector<std::pair<string, string> > vars;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (!_splitAssignment(args[i].c_str(), name, value)) {
+                return false;
+            }
+            vars.push_back(std::make_pair(name, value));
+        }
+        for (const auto& var : vars) {
+            state.set(RcState::RC_ENV, var.first, var.second);
+        }
+        return true;
+    }
+    return false;
+}
+
+// Compiles the rc file into state records. Only the leading run of state
+// lines is folded; from the first command on, every line is kept as a
+// command to run, in order, before the first prompt.
+static bool _compileRc(const string& path, RcState& state) {
+    std::ifstream rc(path.c_str());
+    if (!rc) {
+        return false;
+    }
+    bool commands = false;
+    for (string line; getline(rc, line); ) {
+        line = _trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (!commands && _compileRcState(line, state)) {
+            continue;
+        }
+        commands = true;
+        state.set(RcState::RC_COMMAND, "", line);
+    }
+    return true;
+}
+
+void SmallShell::loadRc() {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return;
+    }
+    string path = string(home) + "/.smashrc";
+    struct stat rc;
+    if (stat(path.c_str(), &rc) < 0) {
+        return;
+    }
+    string snapshot = path + ".snap";
+    RcState state;
+    if (!state.loadSnapshot(snapshot, rc)) {
+        state = RcState();
+        if (!_compileRc(path, state)) {
+            return;
+        }
+        state.saveSnapshot(snapshot, rc);
+    }
+    applyRc(state);
+}
+
+void SmallShell::applyRc(const RcState& state) {
+    for (const RcState::Record& record : state.records()) {
+        switch (record.type) {
+        case RcState::RC_PROMPT:
+            _name = record.value;
+            break;
+        case RcState::RC_ENV:
+            setenv(record.key.c_str(), record.value.c_str(), 1);
+            break;
+        case RcState::RC_CAPTURE:
+            _job_list.capture() = record.value == "on";
+            break;
+        case RcState::RC_CAPTURE_LIMIT:
+            _job_list.setCaptureLimit(strtoul(record.value.c_str(), nullptr, 10));
+            break;
+        case RcState::RC_ALIAS:
+            _aliases.defineAlias(record.key, record.value);
+            break;
+        case RcState::RC_FUNCTION:
+            _aliases.defineFunction(record.key, record.value);
+            break;
+        case RcState::RC_COMMAND:
+            _rc_commands.push_back(record.value);
+            break;
+        }
+    }
 }
 
 SmallShell &SmallShell::getInstance() {
@@ -125,13 +436,59 @@ SmallShell &SmallShell::getInstance() {
 
 
 Command *SmallShell::CreateCommand(const char* cmd_line) {
+    string name, body;
+    if (_parseFunctionDefinition(cmd_line, name, body)) {
+        return new DefineFunctionCommand(cmd_line, name, body);
+    }
+
+    string line(cmd_line);
+    _removeBackgroundSign(&line[0]);
+    char* args[COMMAND_MAX_ARGS + 1];
+    int argc = _parseCommandLine(line.c_str(), args);
+    std::vector<std::string> argv(args, args + argc);
+    for (int i = 0; i < argc; ++i) {
+        free(args[i]);
+    }
+    return CreateCommand(cmd_line, argv);
+}
+
+Command *SmallShell::CreateCommand(const char* cmd_line, std::vector<std::string> argv) {
+    size_t spliced;
+    if (!_aliases.expand(argv, spliced)) {
+        throw Command::CommandError(argv[0] + ": recursive alias");
+    }
+    if (spliced) {
+        // words that came from an alias are globbed like typed ones
+        std::vector<std::string> words;
+        for (size_t i = 0; i < spliced; ++i) {
+            _expandWord(argv[i], words);
+        }
+        words.insert(words.end(), argv.begin() + spliced, argv.end());
+        argv.swap(words);
+    }
+    if (argv.empty()) {
+        return nullptr;
+    }
+    const AliasTable::Function *function = _aliases.function(argv[0]);
+    if (function) {
+        return new FunctionCommand(cmd_line, argv, function);
+    }
+    if (argv.size() > COMMAND_MAX_ARGS) {
+        throw Command::CommandError("too many arguments");
+    }
 
     char* args[COMMAND_MAX_ARGS + 1];
-    _parseCommandLine(cmd_line, args);
+    for (size_t i = 0; i < argv.size(); ++i) {
+        args[i] = (char*)malloc(argv[i].length()+1);
+        strcpy(args[i], argv[i].c_str());
+    }
+    args[argv.size()] = NULL;
     string firstWord(args[0]);
 
     if (firstWord.compare("chprompt") == 0) {
         return new ChpromptCommand(cmd_line, args);
+    } else if (firstWord.compare("export") == 0) {
+        return new ExportCommand(cmd_line, args);
     } else if (firstWord.compare("showpid") == 0) {
         return new ShowPidCommand(cmd_line, args);
     } else if (firstWord.compare("pwd") == 0) {
@@ -144,25 +501,60 @@ Command *SmallShell::CreateCommand(const char* cmd_line) {
         return new ForegroundCommand(cmd_line, args, &_job_list);
     } else if (firstWord.compare("bg") == 0) {
         return new BackgroundCommand(cmd_line, args, &_job_list);
+    } else if (firstWord.compare("joblog") == 0) {
+        return new JoblogCommand(cmd_line, args, &_job_list);
+    } else if (firstWord.compare("kill") == 0) {
+        return new KillCommand(cmd_line, args, &_job_list);
+    } else if (firstWord.compare("wait") == 0) {
+        return new WaitCommand(cmd_line, args, &_job_list);
+    } else if (firstWord.compare("alias") == 0) {
+        return new AliasCommand(cmd_line, args);
+    } else if (firstWord.compare("unalias") == 0) {
+        return new UnaliasCommand(cmd_line, args);
     } else if (firstWord.compare("quit") == 0) {
         return new QuitCommand(cmd_line, args, &_job_list);
     }
-    return new ExternalCommand(cmd_line);
+    return new ExternalCommand(cmd_line, args);
 }
 
 bool SmallShell::executeCommand(const char *cmd_line) {
+    _job_list.removeFinishedJobs();
+    // no command is running, so no ring can be in use
+    _job_list.releaseOutputs();
     try {
         Command* cmd = CreateCommand(cmd_line);
-        if (_isBackgroundComamnd(cmd_line)) {
-            _job_list.addJob(cmd);
+        if (!cmd) {
+            return true;
         }
-        cmd->execute();
+        return executeCommand(cmd);
+    } catch (const Command::CommandError& e) {
+        cerr << "smash error: " << e.what() << endl;
+    }
+    return true;
+}
+
+// runs a created command, as a job if its line ends with &; false if smash
+// should quit
+bool SmallShell::executeCommand(Command *cmd) {
+    if (_isBackgroundComamnd(cmd->cmd_line())) {
+        _job_list.addJob(cmd);
+    }
+    cmd->execute();
+
+    if (dynamic_cast<QuitCommand *>(cmd)) {
+        return false;
+    }
+    FunctionCommand *function = dynamic_cast<FunctionCommand *>(cmd);
+    return !function || !function->quit();
+}
 
-        if (dynamic_cast<QuitCommand *>(cmd)) {
+bool SmallShell::runRcCommands() {
+    std::vector<std::string> commands;
+    commands.swap(_rc_commands);
+    for (const std::string& cmd_line : commands) {
+        if (!executeCommand(cmd_line.c_str())) {
             return false;
         }
-    } catch (const Command::CommandError& e) {
-        cerr << "smash error: " << e.what() << endl;
     }
     return true;
 }
@@ -171,17 +563,95 @@ const std::string& SmallShell::name() const {
     return _name;
 }
 
+bool SmallShell::readLine(std::string& line) {
+    for (;;) {
+        size_t nl = _input.find('\n');
+        if (nl != string::npos) {
+            line = _input.substr(0, nl);
+            _input.erase(0, nl + 1);
+            if (_job_list.capturing()) {
+                // pick up what the jobs wrote while the line was buffered
+                _job_list.pollOutput(-1, 0, nullptr);
+            }
+            return true;
+        }
+        // captured job output is read while the prompt waits for a line
+        if (_job_list.capturing() && !_job_list.pollOutput(STDIN_FILENO, -1, nullptr)) {
+            continue;
+        }
+        char buf[4096];
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // a last line without a newline still counts
+            if (_input.empty()) {
+                return false;
+            }
+            line.swap(_input);
+            _input.clear();
+            return true;
+        }
+        _input.append(buf, n);
+    }
+}
+
+void SmallShell::waitForeground(Command *cmd, OutputRing *follow, bool resume) {
+    // SIGCHLD stays blocked between waitid and ppoll, so no stop is missed;
+    // an exit wakes ppoll through the pidfd itself
+    SignalBlock block(SIGCHLD);
+
+    // the job's group gets the terminal (and with it ctrl-C and ctrl-Z)
+    // before it may run; SIGTTOU is ignored, so smash can take it back
+    bool tty = cmd->pidfd() >= 0 && _ownsTerminal();
+    if (tty) {
+        tcsetpgrp(STDIN_FILENO, cmd->pid());
+    }
+    if (resume) {
+        cmd->sendSignal(SIGCONT, true);
+    }
+    _running_cmd = cmd;
+    unsigned long long shown = follow ? follow->end() : 0;
+    for (;;) {
+        int ret = cmd->wait(WEXITED | WSTOPPED | WNOHANG);
+        if (ret < 0) {
+            perror("smash error: waitid failed");
+        }
+        if (ret != 0) {
+            break;
+        }
+        _job_list.pollOutput(cmd->pidfd(), -1, block.orig());
+        if (follow) {
+            shown = follow->print(cout, shown);
+        }
+    }
+    if (tty) {
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    }
+
+    _running_cmd = nullptr;
+    // not reaped, so it stopped: by handle_ctrl_z, or by ctrl-Z on a
+    // terminal it owned
+    if (cmd->pidfd() >= 0) {
+        _interrupted = 1;
+        _job_list.addJob(cmd, true);
+    }
+}
+
+// Signal handlers never touch the jobs list; it is only changed from the
+// main loop.
 void SmallShell::handle_ctrl_z(int sig_num) {
+    _interrupted = 1;
     if (_running_cmd) {
-        kill(_running_cmd->pid(), sig_num);
-        _job_list.addJob(_running_cmd, true);
-        _running_cmd = nullptr;
+        _running_cmd->sendSignal(sig_num, true);
     }
 }
 
 void SmallShell::handle_sigchld(int sig_num) {
     FUNC_ENTRY()
-    _job_list.removeFinishedJobs();
+    // nothing to do: finished jobs are reaped before each command, and the
+    // signal itself is what interrupts ppoll in waitForeground
 }
 
 /* -------------- BuiltInCommand -------------- */
@@ -208,39 +678,77 @@ Command* &BuiltInCommand::smash_running_cmd() {
     return _smash->_running_cmd;
 }
 
+volatile sig_atomic_t &BuiltInCommand::smash_interrupted() {
+    return _smash->_interrupted;
+}
+
+AliasTable &BuiltInCommand::smash_aliases() {
+    return _smash->_aliases;
+}
+
 /* -------------- ExternalCommand -------------- */
 
-ExternalCommand::ExternalCommand(const char* cmd_line):
+ExternalCommand::ExternalCommand(const char* cmd_line, char* args[]):
     Command(cmd_line) {
+    for (int i = 0; args[i]; ++i) {
+        _argv.push_back(args[i]);
+    }
 }
 
 void ExternalCommand::execute() {
-    char cmd_line[COMMAND_ARGS_MAX_LENGTH];
-    strcpy(cmd_line, this->cmd_line());
+    bool bg_cmd = _isBackgroundComamnd(cmd_line());
+    std::vector<char *> args;
+    for (std::string& arg : _argv) {
+        args.push_back(&arg[0]);
+    }
+    args.push_back(nullptr);
 
-    bool bg_cmd = _isBackgroundComamnd(cmd_line);
-    if (bg_cmd) {
-        _removeBackgroundSign(cmd_line);
+    bool tty = !bg_cmd && _ownsTerminal();
+    int out[2] = {-1, -1};
+    if (bg_cmd && _smash->_job_list.capture() && pipe2(out, O_CLOEXEC) < 0) {
+        perror("smash error: pipe failed");
     }
-    char* args[COMMAND_MAX_ARGS + 1];
-    _parseCommandLine(cmd_line, args);
 
+    // the child can't be reaped before its pidfd is open: smash only ever
+    // waits on pidfds
     int pid = fork();
     if (pid < 0) {
         perror("smash error: fork failed");
     } else if (pid == 0) {
-        execvp(args[0], args);
+        // own process group, so the job can be signalled as a whole
+        setpgid(0, 0);
+        if (tty) {
+            // take the terminal before exec, so the first read can't race smash
+            tcsetpgrp(STDIN_FILENO, getpid());
+        }
+        // smash ignores SIGTTOU; an ignored signal would stay ignored across exec
+        signal(SIGTTOU, SIG_DFL);
+        if (out[1] >= 0) {
+            dup2(out[1], STDOUT_FILENO);
+            dup2(out[1], STDERR_FILENO);
+        }
+        execvp(args[0], args.data());
         perror("smash error: execvp failed");
+        // never fall back into a second copy of the shell loop
+        _exit(1);
     } else {
         _pid = pid;
-        if (!bg_cmd) {
-            _smash->_running_cmd = this;
-            if (waitpid(pid, nullptr, WUNTRACED) < 0) {
-                perror("smash error: waitpid failed");
-            }
-            _smash->_running_cmd = nullptr;
+        setpgid(pid, pid);
+        _pidfd = _pidfdOpen(pid);
+        if (_pidfd < 0) {
+            perror("smash error: pidfd_open failed");
+        }
+        if (out[0] >= 0) {
+            close(out[1]);
+            fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+        }
+        if (bg_cmd) {
+            _smash->_job_list.jobStarted(this, out[0]);
         }
     }
+    if (pid > 0 && !bg_cmd) {
+        _smash->waitForeground(this);
+    }
 }
 
 /* -------------- ChpromptCommand -------------- */
@@ -258,6 +766,31 @@ void ChpromptCommand::execute() {
     smash_name() = _new_name;
 }
 
+/* -------------- ExportCommand -------------- */
+
+ExportCommand::ExportCommand(const char* cmd_line, char* args[]):
+    BuiltInCommand(cmd_line) {
+    string name, value;
+    for (int i = 1; args[i]; ++i) {
+        if (!_splitAssignment(args[i], name, value)) {
+            throw CommandError("export: invalid arguments");
+        }
+        _vars.push_back(std::make_pair(name, value));
+    }
+}
+
+void ExportCommand::execute() {
+    if (_vars.empty()) {
+        for (char **env = environ; *env; ++env) {
+            cout << *env << endl;
+        }
+        return;
+    }
+    for (const auto& var : _vars) {
+        setenv(var.first.c_str(), var.second.c_str(), 1);
+    }
+}
+
 /* -------------- ShowPidCommand -------------- */
 
 ShowPidCommand::ShowPidCommand(const char* cmd_line, char* args[]):
@@ -326,12 +859,59 @@ bool &JobsList::JobEntry::stopped() {
 
 JobsList::JobsList() {
     _next_jid = 1;
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    _capture = false;
+    _capture_limit = JOB_OUTPUT_DEFAULT_LIMIT;
+    _captured = 0;
+    _output_seq = 0;
 }
 
 void JobsList::addJob(Command* cmd, bool stopped) {
     JobEntry *job = new JobEntry(cmd, stopped);
     job->_jid = _next_jid++;
     _jobs.push_back(job);
+    watch(job);
+}
+
+void JobsList::watch(JobEntry *job) {
+    if (job->_cmd->pidfd() < 0) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = job->_cmd->pidfd();
+    epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, job->_cmd->pidfd(), &ev);
+    _watched[job->_cmd->pidfd()] = job;
+}
+
+void JobsList::unwatch(JobEntry *job) {
+    if (job->_cmd->pidfd() >= 0) {
+        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, job->_cmd->pidfd(), nullptr);
+        _watched.erase(job->_cmd->pidfd());
+    }
+}
+
+int JobsList::reapFinished(int timeout_ms, std::set<int> *jids) {
+    struct epoll_event events[JOBS_EPOLL_BATCH];
+    int ready = epoll_wait(_epoll_fd, events, JOBS_EPOLL_BATCH, timeout_ms);
+    for (int i = 0; i < ready; ++i) {
+        auto it = _watched.find(events[i].data.fd);
+        if (it == _watched.end()) {
+            // not a job any more; just stop watching it
+            epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, events[i].data.fd, nullptr);
+            continue;
+        }
+        JobEntry *job = it->second;
+        unwatch(job);
+        job->_cmd->wait(WEXITED | WNOHANG);
+        if (jids) {
+            jids->insert(job->_jid);
+        }
+        _jobs.remove(job);
+        delete job->_cmd;
+        delete job;
+    }
+    return ready;
 }
 
 void JobsList::printJobsList() {
@@ -374,7 +954,6 @@ JobsList::JobEntry *JobsList::getLastJob(int* lastJobId) {
         throw Command::CommandError("something2");
     }
     JobEntry *ret = _jobs.back();
-    _jobs.pop_back();
     if (lastJobId) {
         *lastJobId = ret->_jid;
     }
@@ -401,27 +980,319 @@ JobsList::JobEntry *JobsList::getLastStoppedJob(int* lastJobId) {
 void JobsList::removeJobById(int jid) {
     for (JobEntry *job : _jobs) {
         if (job->_jid == jid) {
+            unwatch(job);
             _jobs.remove(job);
+            delete job;
             return;
         }
     }
 }
 
-void JobsList::killAllJobs() {
-    cout << "smash: sending SIGKILL signal to " << _jobs.size() << " jobs:" << endl;
-    for (const JobEntry *job : _jobs) {
-        cout << job->_cmd->pid() << ": " << job->_cmd->cmd_line() << endl;
-        kill(job->_cmd->pid(), SIGKILL);
+void JobsList::killAllJobs(int grace_ms) {
+    typedef std::chrono::steady_clock clock;
+    struct Victim {
+        JobEntry *job;
+        const char *signal;
+        double ms;
+    };
+    clock::time_point start = clock::now();
+    vector<Victim> victims;
+    // epoll reports pidfds
+    std::map<int, size_t> by_pidfd;
+    cout << "smash: sending SIGTERM signal to " << _jobs.size() << " jobs:" << endl;
+    for (JobEntry *job : _jobs) {
+        int pid = job->_cmd->pid();
+        cout << pid << ": " << job->_cmd->cmd_line() << endl;
+        // builtins run in the background have no process of their own
+        if (job->_cmd->pidfd() < 0) {
+            continue;
+        }
+        job->_cmd->sendSignal(SIGTERM, true);
+        if (job->_stopped) {
+            job->_cmd->sendSignal(SIGCONT, true);
+        }
+        Victim victim = {job, "SIGTERM", 0};
+        by_pidfd[job->_cmd->pidfd()] = victims.size();
+        victims.push_back(victim);
+    }
+
+    // one deadline for all jobs; each exit is reaped as soon as it is seen
+    clock::time_point deadline = start + std::chrono::milliseconds(grace_ms);
+    size_t pending = victims.size();
+    const char *signal = "SIGTERM";
+    while (pending) {
+        int timeout = -1;
+        if (deadline != clock::time_point::max()) {
+            timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - clock::now()).count();
+            if (timeout < 0) {
+                timeout = 0;
+            }
+        }
+        struct epoll_event events[JOBS_EPOLL_BATCH];
+        int ready = epoll_wait(_epoll_fd, events, JOBS_EPOLL_BATCH, timeout);
+        if (ready < 0 && errno != EINTR) {
+            perror("smash error: epoll_wait failed");
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            auto it = by_pidfd.find(events[i].data.fd);
+            if (it == by_pidfd.end()) {
+                continue;
+            }
+            Victim& victim = victims[it->second];
+            by_pidfd.erase(it);
+            unwatch(victim.job);
+            victim.job->_cmd->wait(WEXITED | WNOHANG);
+            victim.ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            victim.signal = signal;
+            --pending;
+        }
+        if (ready == 0 && pending && deadline != clock::time_point::max()) {
+            cout << "smash: sending SIGKILL signal to " << pending << " jobs:" << endl;
+            for (const Victim& victim : victims) {
+                Command *cmd = victim.job->_cmd;
+                if (cmd->pidfd() >= 0) {
+                    cout << cmd->pid() << ": " << cmd->cmd_line() << endl;
+                    cmd->sendSignal(SIGKILL, true);
+                }
+            }
+            deadline = clock::time_point::max();
+            signal = "SIGKILL";
+        }
+    }
+
+    for (const Victim& victim : victims) {
+        // formatted aside, so cout keeps its own precision
+        std::ostringstream ms;
+        ms << std::fixed << std::setprecision(1) << victim.ms;
+        cout << victim.job->_cmd->pid() << ": " << victim.signal << " after "
+             << ms.str() << " ms" << endl;
+    }
+    for (JobEntry *job : _jobs) {
+        delete job;
     }
+    _jobs.clear();
 }
 
 void JobsList::removeFinishedJobs() {
     FUNC_ENTRY()
-    // FIXME
-    list<JobEntry *>::iterator it = _jobs.begin();
-    while (it != _jobs.end()) {
-        if (waitpid(_jobs.back()->cmd()->pid(), nullptr, WNOHANG)) {
-            _jobs.erase(it++);  // alternatively, i = items.erase(i);
+    // only the jobs whose pidfd reported an exit are looked at
+    while (reapFinished(0, nullptr) > 0) {
+    }
+}
+
+JobsList::SelectResult JobsList::selectJobs(const std::string& spec, std::set<int>& jids, int& missing) {
+    if (spec == "%%" || spec == "%+") {
+        if (_jobs.empty()) {
+            return SELECT_EMPTY;
+        }
+        jids.insert(_jobs.back()->_jid);
+        return SELECT_OK;
+    }
+    if (spec == "%all" || spec == "%running" || spec == "%stopped") {
+        for (const JobEntry *job : _jobs) {
+            if (spec == "%all" || job->_stopped == (spec == "%stopped")) {
+                jids.insert(job->_jid);
+            }
+        }
+        return SELECT_OK;
+    }
+
+    // N, %N, N-M, %N-M or %N-%M
+    string from = spec, to;
+    size_t dash = spec.find('-');
+    if (dash != string::npos) {
+        from = spec.substr(0, dash);
+        to = spec.substr(dash + 1);
+    }
+    int first, last;
+    for (string *bound : {&from, &to}) {
+        if (!bound->empty() && (*bound)[0] == '%') {
+            bound->erase(0, 1);
+        }
+    }
+    if (from.empty() || from.find_first_not_of("0123456789") != string::npos ||
+        (dash != string::npos && (to.empty() || to.find_first_not_of("0123456789") != string::npos))) {
+        return SELECT_INVALID;
+    }
+    try {
+        first = stoi(from);
+        last = dash == string::npos ? first : stoi(to);
+    } catch (...) {
+        return SELECT_INVALID;
+    }
+    if (first > last) {
+        return SELECT_INVALID;
+    }
+    bool found = false;
+    for (const JobEntry *job : _jobs) {
+        if (job->_jid >= first && job->_jid <= last) {
+            jids.insert(job->_jid);
+            found = true;
+        }
+    }
+    // a range may be sparse, but must name at least one job
+    if (!found) {
+        missing = first;
+        return SELECT_MISSING;
+    }
+    return SELECT_OK;
+}
+
+void JobsList::signalJobs(const std::set<int>& jids, int sig) {
+    for (JobEntry *job : _jobs) {
+        // a background builtin's pid is smash's own
+        if (!jids.count(job->_jid) || job->_cmd->pidfd() < 0) {
+            continue;
+        }
+        if (job->_cmd->sendSignal(sig, true) < 0) {
+            perror("smash error: kill failed");
+            continue;
+        }
+        cout << "signal number " << sig << " was sent to pid " << job->_cmd->pid() << endl;
+        if (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU) {
+            job->_stopped = true;
+        } else if (sig == SIGCONT) {
+            job->_stopped = false;
+        }
+    }
+}
+
+void JobsList::waitJobs(std::set<int> jids, bool any, volatile sig_atomic_t& interrupted) {
+    for (auto it = jids.begin(); it != jids.end(); ) {
+        bool waitable = false;
+        for (const JobEntry *job : _jobs) {
+            if (job->_jid == *it) {
+                waitable = job->_cmd->pidfd() >= 0;
+                break;
+            }
+        }
+        it = waitable ? ++it : jids.erase(it);
+    }
+
+    // ctrl-Z is only let through inside ppoll, so one that comes between
+    // the check below and the wait still wakes it
+    SignalBlock block(SIGTSTP);
+    interrupted = 0;
+    while (!jids.empty() && !interrupted) {
+        std::set<int> reaped;
+        if (reapFinished(0, &reaped) < 0 && errno != EINTR) {
+            perror("smash error: epoll_wait failed");
+            break;
+        }
+        size_t before = jids.size();
+        for (int jid : reaped) {
+            jids.erase(jid);
+        }
+        if ((any && jids.size() < before) || jids.empty()) {
+            break;
+        }
+        // a captured job can't exit while its pipe is full, so the pipes
+        // are drained while the epoll set is waited on
+        if (reaped.empty()) {
+            pollOutput(_epoll_fd, -1, block.orig());
+        }
+    }
+}
+
+bool &JobsList::capture() {
+    return _capture;
+}
+
+void JobsList::setCaptureLimit(size_t bytes) {
+    _capture_limit = bytes;
+    enforceCaptureLimit();
+}
+
+void JobsList::jobStarted(Command *cmd, int output_fd) {
+    for (JobEntry *job : _jobs) {
+        if (job->_cmd == cmd) {
+            watch(job);
+            if (output_fd >= 0) {
+                delete _outputs[job->_jid];
+                _outputs[job->_jid] = new OutputRing(output_fd);
+            }
+            return;
+        }
+    }
+    if (output_fd >= 0) {
+        close(output_fd);
+    }
+}
+
+OutputRing *JobsList::getOutput(int jid) {
+    auto it = _outputs.find(jid);
+    return it == _outputs.end() ? nullptr : it->second;
+}
+
+bool JobsList::capturing() const {
+    for (const auto& output : _outputs) {
+        if (!output.second->closed()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobsList::pollOutput(int fd, int timeout_ms, const sigset_t *sigmask) {
+    vector<struct pollfd> fds;
+    vector<OutputRing *> rings;
+    if (fd >= 0) {
+        fds.push_back({fd, POLLIN, 0});
+    }
+    for (const auto& output : _outputs) {
+        if (!output.second->closed()) {
+            fds.push_back({output.second->fd(), POLLIN, 0});
+            rings.push_back(output.second);
+        }
+    }
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    if (ppoll(fds.data(), fds.size(), timeout_ms < 0 ? nullptr : &timeout, sigmask) <= 0) {
+        return false;
+    }
+
+    size_t first = fd >= 0 ? 1 : 0;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        if (fds[first + i].revents) {
+            _captured += rings[i]->drain(++_output_seq);
+        }
+    }
+    enforceCaptureLimit();
+    return fd >= 0 && fds[0].revents;
+}
+
+void JobsList::enforceCaptureLimit() {
+    while (_captured > _capture_limit) {
+        OutputRing *oldest = nullptr;
+        for (const auto& output : _outputs) {
+            OutputRing *ring = output.second;
+            if (ring->size() && (!oldest || ring->oldestSeq() < oldest->oldestSeq())) {
+                oldest = ring;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+        _captured -= oldest->evict(_captured - _capture_limit);
+    }
+}
+
+void JobsList::releaseOutputs() {
+    for (auto it = _outputs.begin(); it != _outputs.end(); ) {
+        bool listed = false;
+        for (const JobEntry *job : _jobs) {
+            if (job->_jid == it->first) {
+                listed = true;
+                break;
+            }
+        }
+        OutputRing *ring = it->second;
+        if (!listed && ring->closed() && !ring->size()) {
+            delete ring;
+            it = _outputs.erase(it);
+        } else {
+            ++it;
         }
     }
 }
@@ -477,16 +1348,15 @@ ForegroundCommand::ForegroundCommand(const char* cmd_line, char* args[], JobsLis
 
     } 
 	
-    jobs->removeJobById(jid);
-    _cmd = job->cmd();
 	}
+    _cmd = job->cmd();
+    _output = jobs->getOutput(jid);
+    jobs->removeJobById(jid);
 }
 
 void ForegroundCommand::execute() {
     cout << _cmd->cmd_line() << " : " << _cmd->pid() << endl;
-    kill(_cmd->pid(), SIGCONT);
-    smash_running_cmd() = _cmd;
-    waitpid(_cmd->pid(), nullptr, WUNTRACED);
+    _smash->waitForeground(_cmd, _output, true);
 }
 
 /* -------------- BackgroundCommand -------------- */
@@ -541,7 +1411,267 @@ BackgroundCommand::BackgroundCommand(const char* cmd_line, char* args[], JobsLis
 
 void BackgroundCommand::execute() {
     cout << _cmd->cmd_line() << " : " << _cmd->pid() << endl;
-    kill(_cmd->pid(), SIGCONT);
+    _cmd->sendSignal(SIGCONT, true);
+}
+
+/* -------------- JoblogCommand -------------- */
+
+JoblogCommand::JoblogCommand(const char* cmd_line, char* args[], JobsList* jobs):
+    BuiltInCommand(cmd_line) {
+    _jobs = jobs;
+    _jid = 0;
+    _follow = false;
+    _set_capture = -1;
+    _set_limit = -1;
+    if (!args[1] || (args[2] && args[3])) {
+        throw CommandError("joblog: invalid arguments");
+    }
+    if (strcmp(args[1], "-c") == 0 && args[2]) {
+        if (strcmp(args[2], "on") && strcmp(args[2], "off")) {
+            throw CommandError("joblog: invalid arguments");
+        }
+        _set_capture = strcmp(args[2], "on") == 0;
+        return;
+    }
+    if (strcmp(args[1], "-m") == 0 && args[2]) {
+        try {
+            _set_limit = stol(args[2]);
+        } catch (...) {
+            throw CommandError("joblog: invalid arguments");
+        }
+        if (_set_limit < 0) {
+            throw CommandError("joblog: invalid arguments");
+        }
+        return;
+    }
+    try {
+        _jid = stoi(args[1]);
+    } catch (...) {
+        throw CommandError("joblog: invalid arguments");
+    }
+    if (args[2]) {
+        if (strcmp(args[2], "-f")) {
+            throw CommandError("joblog: invalid arguments");
+        }
+        _follow = true;
+    }
+    if (!_jobs->getOutput(_jid)) {
+        throw CommandError("joblog: job-id " + std::to_string(_jid) + " has no captured output");
+    }
+}
+
+void JoblogCommand::execute() {
+    if (_set_capture >= 0) {
+        _jobs->capture() = _set_capture;
+        return;
+    }
+    if (_set_limit >= 0) {
+        _jobs->setCaptureLimit(_set_limit);
+        return;
+    }
+    OutputRing *output = _jobs->getOutput(_jid);
+    // pick up whatever is already waiting in the pipes
+    _jobs->pollOutput(-1, 0, nullptr);
+    unsigned long long shown = output->print(cout, output->begin());
+    // follow until the job closes its output or ctrl-Z is pressed
+    smash_interrupted() = 0;
+    while (_follow && !output->closed() && !smash_interrupted()) {
+        _jobs->pollOutput(-1, -1, nullptr);
+        shown = output->print(cout, shown);
+    }
+}
+
+/* -------------- AliasCommand -------------- */
+
+AliasCommand::AliasCommand(const char* cmd_line, char* args[]):
+    BuiltInCommand(cmd_line) {
+    if (args[1] && !_parseAliasDefinition(cmd_line, _name, _value)) {
+        throw CommandError("alias: invalid arguments");
+    }
+}
+
+void AliasCommand::execute() {
+    if (_name.empty()) {
+        for (const auto& alias : smash_aliases().aliases()) {
+            cout << alias.first << "='" << alias.second << "'" << endl;
+        }
+        return;
+    }
+    smash_aliases().defineAlias(_name, _value);
+}
+
+/* -------------- UnaliasCommand -------------- */
+
+UnaliasCommand::UnaliasCommand(const char* cmd_line, char* args[]):
+    BuiltInCommand(cmd_line) {
+    if (!args[1]) {
+        throw CommandError("unalias: invalid arguments");
+    }
+    for (int i = 1; args[i]; ++i) {
+        _names.push_back(args[i]);
+    }
+}
+
+void UnaliasCommand::execute() {
+    for (const std::string& name : _names) {
+        if (!smash_aliases().removeAlias(name)) {
+            throw CommandError("unalias: " + name + " not found");
+        }
+    }
+}
+
+/* -------------- DefineFunctionCommand -------------- */
+
+DefineFunctionCommand::DefineFunctionCommand(const char* cmd_line, const std::string& name,
+                                             const std::string& body):
+    BuiltInCommand(cmd_line) {
+    _name = name;
+    _body = body;
+}
+
+void DefineFunctionCommand::execute() {
+    smash_aliases().defineFunction(_name, _body);
+}
+
+/* -------------- FunctionCommand -------------- */
+
+FunctionCommand::FunctionCommand(const char* cmd_line, const std::vector<std::string>& argv,
+                                 const AliasTable::Function *function):
+    BuiltInCommand(cmd_line) {
+    _argv = argv;
+    _function = function;
+    _quit = false;
+}
+
+bool FunctionCommand::quit() const {
+    return _quit;
+}
+
+void FunctionCommand::execute() {
+    const std::string& name = _argv[0];
+    if (!smash_aliases().enterFunction(name)) {
+        throw CommandError(name + ": recursive function call");
+    }
+    // a redefinition while running must not pull the body from under us
+    AliasTable::Function function = *_function;
+    for (const AliasTable::Statement& statement : function.statements) {
+        // $0..$9, $# and $@ are substituted as whole words
+        std::vector<std::string> argv;
+        for (const std::string& token : statement.tokens) {
+            if (token == "$@") {
+                argv.insert(argv.end(), _argv.begin() + 1, _argv.end());
+            } else if (token == "$#") {
+                argv.push_back(std::to_string(_argv.size() - 1));
+            } else if (token.size() == 2 && token[0] == '$' && isdigit(token[1])) {
+                size_t i = token[1] - '0';
+                if (i < _argv.size()) {
+                    argv.push_back(_argv[i]);
+                }
+            } else {
+                _expandWord(token, argv);
+            }
+        }
+        try {
+            Command *cmd = _smash->CreateCommand(statement.text.c_str(), argv);
+            if (!cmd) {
+                continue;
+            }
+            if (!_smash->executeCommand(cmd)) {
+                _quit = true;
+                break;
+            }
+        } catch (const CommandError& e) {
+            cerr << "smash error: " << e.what() << endl;
+        }
+    }
+    smash_aliases().leaveFunction(name);
+}
+
+/* -------------- KillCommand -------------- */
+
+// resolves the job specs in args, from index i on, for the builtin `name`
+static void _selectJobs(JobsList *jobs, const string& name, char* args[], int i, std::set<int>& jids) {
+    for (; args[i]; ++i) {
+        int missing;
+        switch (jobs->selectJobs(args[i], jids, missing)) {
+        case JobsList::SELECT_OK:
+            break;
+        case JobsList::SELECT_INVALID:
+            throw Command::CommandError(name + ": invalid arguments");
+        case JobsList::SELECT_MISSING:
+            throw Command::CommandError(name + ": job-id " + std::to_string(missing) + " does not exist");
+        case JobsList::SELECT_EMPTY:
+            throw Command::CommandError(name + ": jobs list is empty");
+        }
+    }
+}
+
+// -9, -KILL or -SIGKILL; -1 if the name is not a signal
+static int _parseSignal(const char *arg) {
+    static const std::pair<const char *, int> signals[] = {
+        {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"ILL", SIGILL},
+        {"TRAP", SIGTRAP}, {"ABRT", SIGABRT}, {"BUS", SIGBUS}, {"FPE", SIGFPE},
+        {"KILL", SIGKILL}, {"USR1", SIGUSR1}, {"SEGV", SIGSEGV}, {"USR2", SIGUSR2},
+        {"PIPE", SIGPIPE}, {"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"CHLD", SIGCHLD},
+        {"CONT", SIGCONT}, {"STOP", SIGSTOP}, {"TSTP", SIGTSTP}, {"TTIN", SIGTTIN},
+        {"TTOU", SIGTTOU},
+    };
+    string name(arg + 1);
+    if (!name.empty() && name.find_first_not_of("0123456789") == string::npos) {
+        int sig = atoi(name.c_str());
+        return sig > 0 && sig <= SIGRTMAX ? sig : -1;
+    }
+    if (name.compare(0, 3, "SIG") == 0) {
+        name.erase(0, 3);
+    }
+    for (const auto& signal : signals) {
+        if (name == signal.first) {
+            return signal.second;
+        }
+    }
+    return -1;
+}
+
+KillCommand::KillCommand(const char* cmd_line, char* args[], JobsList* jobs):
+    BuiltInCommand(cmd_line) {
+    _jobs = jobs;
+    _sig = SIGTERM;
+    int i = 1;
+    if (args[1] && args[1][0] == '-') {
+        _sig = _parseSignal(args[1]);
+        ++i;
+    }
+    if (_sig < 0 || !args[i]) {
+        throw CommandError("kill: invalid arguments");
+    }
+    _selectJobs(_jobs, "kill", args, i, _jids);
+}
+
+void KillCommand::execute() {
+    _jobs->signalJobs(_jids, _sig);
+}
+
+/* -------------- WaitCommand -------------- */
+
+WaitCommand::WaitCommand(const char* cmd_line, char* args[], JobsList* jobs):
+    BuiltInCommand(cmd_line) {
+    _jobs = jobs;
+    _any = false;
+    int i = 1;
+    if (args[1] && strcmp(args[1], "-n") == 0) {
+        _any = true;
+        ++i;
+    }
+    if (!args[i]) {
+        // stopped jobs would never finish on their own
+        int missing;
+        _jobs->selectJobs("%running", _jids, missing);
+    }
+    _selectJobs(_jobs, "wait", args, i, _jids);
+}
+
+void WaitCommand::execute() {
+    _jobs->waitJobs(_jids, _any, smash_interrupted());
 }
 
 /* -------------- QuitCommand -------------- */
@@ -549,17 +1679,31 @@ void BackgroundCommand::execute() {
 QuitCommand::QuitCommand(const char* cmd_line, char* args[], JobsList* jobs):
     BuiltInCommand(cmd_line) {
     _kill = false;
+    _grace_ms = QUIT_KILL_DEFAULT_GRACE_MS;
     _jobs = jobs;
     if (args[1]) {
         if (strcmp(args[1], "kill")) {
-            throw CommandError("todo");
+            throw CommandError("quit: invalid arguments");
         }
         _kill = true;
+        if (args[2]) {
+            if (strcmp(args[2], "--grace") || !args[3] || args[4]) {
+                throw CommandError("quit: invalid arguments");
+            }
+            try {
+                _grace_ms = stoi(args[3]);
+            } catch (...) {
+                throw CommandError("quit: invalid arguments");
+            }
+            if (_grace_ms < 0) {
+                throw CommandError("quit: invalid arguments");
+            }
+        }
     }
 }
 
 void QuitCommand::execute() {
     if (_kill) {
-        _jobs->killAllJobs();
+        _jobs->killAllJobs(_grace_ms);
     }
 }
\ No newline at end of file
@@ -4,18 +4,34 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <signal.h>
+#include "Aliases.h"
 
 #define COMMAND_ARGS_MAX_LENGTH (80)
 #define COMMAND_MAX_ARGS (20)
+#define JOB_OUTPUT_DEFAULT_LIMIT (1 << 20)
+#define QUIT_KILL_DEFAULT_GRACE_MS (1000)
+#define JOBS_EPOLL_BATCH (64)
 
 class SmallShell;
+class OutputRing;
+class RcState;
 class Command {
 public:
     Command(const char* cmd_line);
-    virtual ~Command() {}
+    virtual ~Command();
     virtual void execute() = 0;
     int pid();
+    int pidfd();
     const char *cmd_line();
+    // signals through the pidfd, so a reused pid is never hit
+    int sendSignal(int sig, bool group = false);
+    // waitid() on the pidfd; 1 if the state changed, 0 if not (WNOHANG)
+    // and -1 on error. The pidfd is closed once the process is reaped.
+    int wait(int options);
 
     class CommandError;
 private:
@@ -23,6 +39,7 @@ private:
 protected:
     SmallShell *_smash;
     int _pid;
+    int _pidfd;
 };
 
 class Command::CommandError {
@@ -45,8 +62,16 @@ private:                                            \
     char *_cwd;                                     \
     bool _cd_called;                                \
     JobsList _job_list;                             \
+    AliasTable _aliases;                            \
                                                     \
     Command* _running_cmd;                          \
+    volatile sig_atomic_t _interrupted;             \
+    std::vector<std::string> _rc_commands;          \
+    /* stdin read but not yet split into lines */   \
+    std::string _input;                             \
+                                                    \
+    void loadRc();                                  \
+    void applyRc(const RcState& state);             \
                                                     \
 public:                                             \
     static SmallShell& getInstance();               \
@@ -55,8 +80,16 @@ public:                                             \
     ~SmallShell() {}                                \
                                                     \
     Command *CreateCommand(const char* cmd_line);   \
+    Command *CreateCommand(const char* cmd_line,    \
+            std::vector<std::string> argv);         \
     bool executeCommand(const char* cmd_line);      \
+    bool executeCommand(Command *cmd);              \
+    bool runRcCommands();                           \
     const std::string& name() const;                \
+    bool readLine(std::string& line);               \
+    void waitForeground(Command *cmd,               \
+            OutputRing *follow = nullptr,           \
+            bool resume = false);                   \
     void handle_ctrl_z(int sig_num);                \
     void handle_sigchld(int sig_num);               \
 };
@@ -68,14 +101,18 @@ protected:
     char *smash_cwd();
     bool &smash_cd_called();
     Command* &smash_running_cmd();
+    volatile sig_atomic_t &smash_interrupted();
+    AliasTable &smash_aliases();
 public:
     BuiltInCommand(const char* cmd_line);
     virtual ~BuiltInCommand() {}
 };
 
 class ExternalCommand : public Command {
+private:
+    std::vector<std::string> _argv;
 public:
-    ExternalCommand(const char* cmd_line);
+    ExternalCommand(const char* cmd_line, char* args[]);
     virtual ~ExternalCommand() {}
     void execute() override;
 };
@@ -89,6 +126,15 @@ public:
     void execute() override;
 };
 
+class ExportCommand : public BuiltInCommand {
+private:
+    std::vector<std::pair<std::string, std::string> > _vars;
+public:
+    ExportCommand(const char* cmd_line, char* args[]);
+    virtual ~ExportCommand() {}
+    void execute() override;
+};
+
 class ShowPidCommand : public BuiltInCommand {
 public:
     ShowPidCommand(const char* cmd_line, char* args[]);
@@ -119,17 +165,52 @@ public:
     ~JobsList() {}
     void addJob(Command* cmd, bool stopped = false);
     void printJobsList();
-    void killAllJobs();
+    // SIGTERM to every job, SIGKILL to those still alive after grace_ms
+    void killAllJobs(int grace_ms);
     void removeFinishedJobs();
     JobEntry * getJobById(int jobId);
     void removeJobById(int jobId);
     JobEntry * getLastJob(int* lastJobId); // add support when it's nullptr
     JobEntry *getLastStoppedJob(int *jobId);
 	bool isStopped(int jobId);
+    enum SelectResult { SELECT_OK, SELECT_INVALID, SELECT_MISSING, SELECT_EMPTY };
+    // Resolves a job spec (N, %N, N-M, %%, %all, %running, %stopped) into
+    // jids. On SELECT_MISSING, missing is the jid that does not exist.
+    SelectResult selectJobs(const std::string& spec, std::set<int>& jids, int& missing);
+    // one pass over the list; each job's process group gets the signal
+    void signalJobs(const std::set<int>& jids, int sig);
+    // blocks on the pidfd epoll set and the capture pipes until all of jids
+    // (or, with any, one of them) have exited; ctrl-Z gives up early
+    void waitJobs(std::set<int> jids, bool any, volatile sig_atomic_t& interrupted);
+    // output capture of background jobs (joblog)
+    bool &capture();
+    void setCaptureLimit(size_t bytes);
+    // registers a started job's pidfd and, if captured, its output pipe
+    void jobStarted(Command *cmd, int output_fd);
+    OutputRing *getOutput(int jid);
+    bool capturing() const;
+    bool pollOutput(int fd, int timeout_ms, const sigset_t *sigmask);
+    // frees the output of jobs that are gone once all of it was evicted
+    void releaseOutputs();
 //   TODO: Add extra methods or modify exisitng ones as needed
 private:
+    void enforceCaptureLimit();
+    void watch(JobEntry *job);
+    void unwatch(JobEntry *job);
+    // one epoll_wait; jobs whose pidfd is ready are reaped and dropped
+    int reapFinished(int timeout_ms, std::set<int> *jids);
+
     std::list<JobEntry *> _jobs;
     int _next_jid;
+    // the pidfds of all jobs
+    int _epoll_fd;
+    std::unordered_map<int, JobEntry *> _watched;
+    // keyed by jid, so the output outlives the job entry itself
+    std::map<int, OutputRing *> _outputs;
+    bool _capture;
+    size_t _capture_limit;
+    size_t _captured;
+    unsigned long _output_seq;
 };
 
 class JobsList::JobEntry {
@@ -162,6 +243,7 @@ public:
 
 class ForegroundCommand : public BuiltInCommand {
     Command *_cmd;
+    OutputRing *_output;
 public:
     ForegroundCommand(const char* cmd_line, char* args[], JobsList* jobs);
     virtual ~ForegroundCommand() {}
@@ -176,8 +258,83 @@ public:
     void execute() override;
 };
 
+class JoblogCommand : public BuiltInCommand {
+    JobsList *_jobs;
+    int _jid;
+    bool _follow;
+    int _set_capture;
+    long _set_limit;
+public:
+    JoblogCommand(const char* cmd_line, char* args[], JobsList* jobs);
+    virtual ~JoblogCommand() {}
+    void execute() override;
+};
+
+class AliasCommand : public BuiltInCommand {
+private:
+    std::string _name;
+    std::string _value;
+public:
+    AliasCommand(const char* cmd_line, char* args[]);
+    virtual ~AliasCommand() {}
+    void execute() override;
+};
+
+class UnaliasCommand : public BuiltInCommand {
+private:
+    std::vector<std::string> _names;
+public:
+    UnaliasCommand(const char* cmd_line, char* args[]);
+    virtual ~UnaliasCommand() {}
+    void execute() override;
+};
+
+class DefineFunctionCommand : public BuiltInCommand {
+private:
+    std::string _name;
+    std::string _body;
+public:
+    DefineFunctionCommand(const char* cmd_line, const std::string& name, const std::string& body);
+    virtual ~DefineFunctionCommand() {}
+    void execute() override;
+};
+
+class FunctionCommand : public BuiltInCommand {
+private:
+    std::vector<std::string> _argv;
+    const AliasTable::Function *_function;
+    bool _quit;
+public:
+    FunctionCommand(const char* cmd_line, const std::vector<std::string>& argv,
+                    const AliasTable::Function *function);
+    virtual ~FunctionCommand() {}
+    void execute() override;
+    bool quit() const;
+};
+
+class KillCommand : public BuiltInCommand {
+    JobsList *_jobs;
+    int _sig;
+    std::set<int> _jids;
+public:
+    KillCommand(const char* cmd_line, char* args[], JobsList* jobs);
+    virtual ~KillCommand() {}
+    void execute() override;
+};
+
+class WaitCommand : public BuiltInCommand {
+    JobsList *_jobs;
+    bool _any;
+    std::set<int> _jids;
+public:
+    WaitCommand(const char* cmd_line, char* args[], JobsList* jobs);
+    virtual ~WaitCommand() {}
+    void execute() override;
+};
+
 class QuitCommand : public BuiltInCommand {
     bool _kill;
+    int _grace_ms;
     JobsList* _jobs;
 public:
     QuitCommand(const char* cmd_line, char* args[], JobsList* jobs);
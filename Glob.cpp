@@ -0,0 +1,427 @@
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include "Glob.h"
+
+using namespace std;
+
+// the cache is dropped rather than grown past this many directories
+#define DIR_CACHE_MAX_LISTINGS (4096)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static string _joinPath(const string& dir, const string& name) {
+  if (dir.empty()) {
+    return name;
+  }
+  if (dir[dir.size() - 1] == '/') {
+    return dir + name;
+  }
+  return dir + "/" + name;
+}
+
+static string _listPath(const string& dir) {
+  return dir.empty() ? "." : dir;
+}
+
+string globUnescape(const std::string& word) {
+  string ret;
+  for (size_t i = 0; i < word.size(); ++i) {
+    if (word[i] == '\\' && i + 1 < word.size()) {
+      ++i;
+    }
+    ret += word[i];
+  }
+  return ret;
+}
+
+// returns the index of the ']' closing the class opened at word[open]
+static size_t _classEnd(const string& word, size_t open) {
+  size_t i = open + 1;
+  if (i < word.size() && (word[i] == '!' || word[i] == '^')) {
+    ++i;
+  }
+  if (i < word.size() && word[i] == ']') {
+    ++i;
+  }
+  return word.find(']', i);
+}
+
+static bool _before(const struct timespec& a, const struct timespec& b) {
+  return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+bool hasGlobChars(const string& word) {
+  for (size_t i = 0; i < word.size(); ++i) {
+    if (word[i] == '\\') {
+      ++i;
+    } else if (word[i] == '*' || word[i] == '?') {
+      return true;
+    } else if (word[i] == '[' && _classEnd(word, i) != string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* -------------- GlobMatcher -------------- */
+
+GlobMatcher::GlobMatcher(const std::string& pattern) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        Op op;
+        op.ch = 0;
+        op.cls = -1;
+        char c = pattern[i];
+        if (c == '*') {
+            op.type = OP_STAR;
+            // consecutive stars are the same as one
+            if (!_ops.empty() && _ops.back().type == OP_STAR) {
+                continue;
+            }
+        } else if (c == '?') {
+            op.type = OP_ANY;
+        } else if (c == '[' && _classEnd(pattern, i) != string::npos) {
+            size_t end = _classEnd(pattern, i);
+            size_t j = i + 1;
+            bool negate = pattern[j] == '!' || pattern[j] == '^';
+            if (negate) {
+                ++j;
+            }
+            std::bitset<256> cls;
+            // the first character may be a literal ']'
+            for (size_t k = j; k < end; ++k) {
+                unsigned char lo = pattern[k];
+                if (k + 2 < end && pattern[k + 1] == '-') {
+                    unsigned char hi = pattern[k + 2];
+                    for (unsigned int ch = lo; ch <= hi; ++ch) {
+                        cls.set(ch);
+                    }
+                    k += 2;
+                } else {
+                    cls.set(lo);
+                }
+            }
+            if (negate) {
+                cls.flip();
+            }
+            op.type = OP_CLASS;
+            op.cls = _classes.size();
+            _classes.push_back(cls);
+            i = end;
+        } else {
+            if (c == '\\' && i + 1 < pattern.size()) {
+                c = pattern[++i];
+            }
+            op.type = OP_CHAR;
+            op.ch = c;
+        }
+        _ops.push_back(op);
+    }
+
+    size_t i = 0;
+    while (i < _ops.size() && _ops[i].type == OP_CHAR) {
+        _prefix += _ops[i++].ch;
+    }
+    size_t j = _ops.size();
+    while (j > i && _ops[j - 1].type == OP_CHAR) {
+        --j;
+    }
+    // a suffix only exists behind the last star
+    if (j > i && _ops[j - 1].type == OP_STAR) {
+        for (size_t k = j; k < _ops.size(); ++k) {
+            _suffix += _ops[k].ch;
+        }
+    }
+    _hidden = !_prefix.empty() && _prefix[0] == '.';
+}
+
+bool GlobMatcher::matchesHidden() const {
+    return _hidden;
+}
+
+bool GlobMatcher::matchOp(const Op& op, unsigned char c) const {
+    switch (op.type) {
+    case OP_CHAR:
+        return op.ch == c;
+    case OP_ANY:
+        return true;
+    case OP_CLASS:
+        return _classes[op.cls].test(c);
+    default:
+        return false;
+    }
+}
+
+bool GlobMatcher::match(const std::string& name) const {
+    // cheap rejects on the literal head and tail before the full match
+    if (name.size() < _prefix.size() + _suffix.size() ||
+        name.compare(0, _prefix.size(), _prefix) != 0 ||
+        name.compare(name.size() - _suffix.size(), _suffix.size(), _suffix) != 0) {
+        return false;
+    }
+
+    size_t p = 0, s = 0;
+    size_t star_p = string::npos, star_s = 0;
+    while (s < name.size()) {
+        if (p < _ops.size() && _ops[p].type == OP_STAR) {
+            star_p = p++;
+            star_s = s;
+        } else if (p < _ops.size() && matchOp(_ops[p], name[s])) {
+            ++p;
+            ++s;
+        } else if (star_p != string::npos) {
+            // let the last star swallow one more character and retry
+            p = star_p + 1;
+            s = ++star_s;
+        } else {
+            return false;
+        }
+    }
+    while (p < _ops.size() && _ops[p].type == OP_STAR) {
+        ++p;
+    }
+    return p == _ops.size();
+}
+
+/* -------------- DirCache -------------- */
+
+DirCache::DirCache() {
+    _generation = 0;
+}
+
+DirCache &DirCache::getInstance() {
+    static DirCache instance;
+    return instance;
+}
+
+void DirCache::nextGeneration() {
+    ++_generation;
+    if (_listings.size() > DIR_CACHE_MAX_LISTINGS) {
+        _listings.clear();
+    }
+}
+
+void DirCache::clear() {
+    _listings.clear();
+}
+
+bool DirCache::scan(const std::string& dir, Listing& listing) {
+    alignas(struct linux_dirent64) static char buf[1 << 16];
+    struct timespec start;
+    clock_gettime(CLOCK_REALTIME_COARSE, &start);
+
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    listing.entries.clear();
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        if (n < 0) {
+            close(fd);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            const char *name = d->d_name;
+            if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+                continue;
+            }
+            Entry entry;
+            entry.name = name;
+            entry.type = d->d_type;
+            listing.entries.push_back(entry);
+        }
+    }
+    close(fd);
+    // sorted once here so that matches from one directory come out in order
+    sort(listing.entries.begin(), listing.entries.end(),
+         [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    listing.mtime = st.st_mtim;
+    // timestamps come from the coarse clock, so a change after the scan
+    // started can only carry an mtime >= start
+    listing.racy = !_before(st.st_mtim, start);
+    listing.generation = _generation;
+    return true;
+}
+
+const std::vector<DirCache::Entry> *DirCache::list(const std::string& dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) < 0 || !S_ISDIR(st.st_mode)) {
+        return nullptr;
+    }
+    std::pair<dev_t, ino_t> key(st.st_dev, st.st_ino);
+    auto it = _listings.find(key);
+    if (it != _listings.end()) {
+        Listing& listing = it->second;
+        if (listing.mtime.tv_sec == st.st_mtim.tv_sec &&
+            listing.mtime.tv_nsec == st.st_mtim.tv_nsec &&
+            (!listing.racy || listing.generation == _generation)) {
+            return &listing.entries;
+        }
+    }
+    Listing& listing = _listings[key];
+    if (!scan(dir, listing)) {
+        _listings.erase(key);
+        return nullptr;
+    }
+    return &listing.entries;
+}
+
+bool DirCache::isDir(const std::string& dir, const Entry& entry, bool follow) {
+    if (entry.type == DT_DIR) {
+        return true;
+    }
+    if (entry.type != DT_UNKNOWN && (entry.type != DT_LNK || !follow)) {
+        return false;
+    }
+    struct stat st;
+    string path = _joinPath(dir, entry.name);
+    int ret = follow ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+    return ret == 0 && S_ISDIR(st.st_mode);
+}
+
+/* -------------- globExpand -------------- */
+
+// appends every non-hidden path below dir; symlinks are not descended into
+static void _collectTree(const string& dir, bool dirs_only, vector<string>& out) {
+  DirCache& cache = DirCache::getInstance();
+  const vector<DirCache::Entry> *entries = cache.list(_listPath(dir));
+  if (!entries) {
+    return;
+  }
+  for (const DirCache::Entry& entry : *entries) {
+    if (entry.name[0] == '.') {
+      continue;
+    }
+    string path = _joinPath(dir, entry.name);
+    bool is_dir = cache.isDir(_listPath(dir), entry, false);
+    if (is_dir || !dirs_only) {
+      out.push_back(path);
+    }
+    if (is_dir) {
+      _collectTree(path, dirs_only, out);
+    }
+  }
+}
+
+int globExpand(const std::string& pattern, std::vector<std::string>& matches) {
+  DirCache& cache = DirCache::getInstance();
+  cache.nextGeneration();
+
+  vector<string> comps;
+  size_t start = 0;
+  while (start <= pattern.size()) {
+    size_t end = pattern.find('/', start);
+    if (end == string::npos) {
+      end = pattern.size();
+    }
+    if (end > start) {
+      comps.push_back(pattern.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  if (comps.empty()) {
+    return 0;
+  }
+  bool trailing_slash = pattern[pattern.size() - 1] == '/';
+
+  vector<string> paths(1, pattern[0] == '/' ? "/" : "");
+  bool last_literal = false;
+  bool sorted = true;
+  for (size_t i = 0; i < comps.size() && !paths.empty(); ++i) {
+    bool last = i + 1 == comps.size();
+    bool dirs_only = !last || trailing_slash;
+    vector<string> next;
+    last_literal = false;
+    sorted = paths.size() == 1;
+
+    if (comps[i] == "**") {
+      for (const string& path : paths) {
+        if (!last) {
+          // ** also matches zero directories
+          next.push_back(path);
+        } else if (!path.empty() && path != "/") {
+          // as with bash's globstar, a trailing ** includes the directory
+          next.push_back(trailing_slash ? path : path + "/");
+        }
+        _collectTree(path, dirs_only, next);
+      }
+      // the tree is walked depth first, which is not name order
+      sorted = false;
+    } else if (!hasGlobChars(comps[i])) {
+      string name = globUnescape(comps[i]);
+      for (const string& path : paths) {
+        next.push_back(_joinPath(path, name));
+      }
+      last_literal = true;
+    } else {
+      GlobMatcher matcher(comps[i]);
+      for (const string& path : paths) {
+        string dir = _listPath(path);
+        const vector<DirCache::Entry> *entries = cache.list(dir);
+        if (!entries) {
+          continue;
+        }
+        for (const DirCache::Entry& entry : *entries) {
+          if (entry.name[0] == '.' && !matcher.matchesHidden()) {
+            continue;
+          }
+          if (!matcher.match(entry.name)) {
+            continue;
+          }
+          if (dirs_only && !cache.isDir(dir, entry, true)) {
+            continue;
+          }
+          next.push_back(_joinPath(path, entry.name));
+        }
+      }
+    }
+    paths.swap(next);
+  }
+
+  // only a literal last component can name a path that does not exist
+  if (last_literal) {
+    vector<string> existing;
+    for (const string& path : paths) {
+      struct stat st;
+      int ret = trailing_slash ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+      if (ret == 0 && (!trailing_slash || S_ISDIR(st.st_mode))) {
+        existing.push_back(path);
+      }
+    }
+    paths.swap(existing);
+  }
+
+  if (!sorted) {
+    sort(paths.begin(), paths.end());
+  }
+  for (string& path : paths) {
+    if (trailing_slash) {
+      path += "/";
+    }
+    matches.push_back(std::move(path));
+  }
+  return paths.size();
+}
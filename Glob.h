@@ -0,0 +1,79 @@
+#ifndef SMASH_GLOB_H_
+#define SMASH_GLOB_H_
+
+#include <string>
+#include <vector>
+#include <bitset>
+#include <map>
+#include <utility>
+#include <sys/types.h>
+#include <time.h>
+
+// Matches a single path component against a wildcard pattern (*, ?, [...]).
+// The pattern is compiled once; match() never allocates.
+class GlobMatcher {
+public:
+    GlobMatcher(const std::string& pattern);
+    bool match(const std::string& name) const;
+    bool matchesHidden() const;
+
+private:
+    enum OpType { OP_CHAR, OP_ANY, OP_STAR, OP_CLASS };
+    struct Op {
+        OpType type;
+        unsigned char ch;
+        int cls;
+    };
+    bool matchOp(const Op& op, unsigned char c) const;
+
+    std::vector<Op> _ops;
+    std::vector<std::bitset<256> > _classes;
+    std::string _prefix;
+    std::string _suffix;
+    bool _hidden;
+};
+
+// Directory listings read with getdents64, cached per directory and reused
+// for as long as the directory's mtime is unchanged.
+class DirCache {
+public:
+    struct Entry {
+        std::string name;
+        unsigned char type;
+    };
+    static DirCache& getInstance();
+    DirCache(DirCache const&)      = delete;
+    void operator=(DirCache const&)  = delete;
+
+    // called once per expansion; a listing is never rescanned twice in one
+    void nextGeneration();
+    // forgets every listing, so the next expansion scans from scratch
+    void clear();
+    // nullptr if the directory cannot be read
+    const std::vector<Entry> *list(const std::string& dir);
+    bool isDir(const std::string& dir, const Entry& entry, bool follow);
+
+private:
+    DirCache();
+    struct Listing {
+        struct timespec mtime;
+        // mtime was not older than the scan, so a later change may share it
+        bool racy;
+        unsigned long generation;
+        std::vector<Entry> entries;
+    };
+    bool scan(const std::string& dir, Listing& listing);
+
+    std::map<std::pair<dev_t, ino_t>, Listing> _listings;
+    unsigned long _generation;
+};
+
+bool hasGlobChars(const std::string& word);
+// the word with its quoting backslashes removed, as used when taken literally
+std::string globUnescape(const std::string& word);
+
+// Appends the sorted expansion of pattern to matches (*, ?, [...] and **).
+// Returns the number of paths appended; 0 means nothing matched.
+int globExpand(const std::string& pattern, std::vector<std::string>& matches);
+
+#endif //SMASH_GLOB_H_
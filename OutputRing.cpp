@@ -0,0 +1,108 @@
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include "OutputRing.h"
+
+using namespace std;
+
+OutputRing::OutputRing(int fd) {
+    _fd = fd;
+    _size = 0;
+    _begin = 0;
+}
+
+OutputRing::~OutputRing() {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+int OutputRing::fd() const {
+    return _fd;
+}
+
+bool OutputRing::closed() const {
+    return _fd < 0;
+}
+
+size_t OutputRing::size() const {
+    return _size;
+}
+
+unsigned long long OutputRing::begin() const {
+    return _begin;
+}
+
+unsigned long long OutputRing::end() const {
+    return _begin + _size;
+}
+
+void OutputRing::append(const char *buf, size_t len, unsigned long seq) {
+    while (len > 0) {
+        if (_chunks.empty() || _chunks.back().data.size() == JOB_OUTPUT_CHUNK) {
+            Chunk chunk;
+            chunk.seq = seq;
+            chunk.data.reserve(JOB_OUTPUT_CHUNK);
+            _chunks.push_back(chunk);
+        }
+        string& data = _chunks.back().data;
+        size_t n = min(len, JOB_OUTPUT_CHUNK - data.size());
+        data.append(buf, n);
+        buf += n;
+        len -= n;
+        _size += n;
+    }
+}
+
+size_t OutputRing::drain(unsigned long seq) {
+    char buf[JOB_OUTPUT_CHUNK];
+    size_t total = 0;
+    while (_fd >= 0 && total < JOB_OUTPUT_MAX_DRAIN) {
+        ssize_t n = read(_fd, buf, sizeof(buf));
+        if (n > 0) {
+            append(buf, n, seq);
+            total += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || errno != EAGAIN) {
+                // every writer is gone (or the pipe broke)
+                close(_fd);
+                _fd = -1;
+            }
+            break;
+        }
+    }
+    return total;
+}
+
+unsigned long OutputRing::oldestSeq() const {
+    return _chunks.front().seq;
+}
+
+size_t OutputRing::evict(size_t bytes) {
+    Chunk& chunk = _chunks.front();
+    size_t n = min(bytes, chunk.data.size());
+    if (n == chunk.data.size()) {
+        _chunks.pop_front();
+    } else {
+        chunk.data.erase(0, n);
+    }
+    _size -= n;
+    _begin += n;
+    return n;
+}
+
+unsigned long long OutputRing::print(std::ostream& out, unsigned long long from) const {
+    unsigned long long pos = _begin;
+    for (const Chunk& chunk : _chunks) {
+        unsigned long long next = pos + chunk.data.size();
+        if (next > from) {
+            size_t skip = from > pos ? from - pos : 0;
+            out.write(chunk.data.data() + skip, chunk.data.size() - skip);
+        }
+        pos = next;
+    }
+    out.flush();
+    return end();
+}
@@ -0,0 +1,52 @@
+#ifndef SMASH_OUTPUT_RING_H_
+#define SMASH_OUTPUT_RING_H_
+
+#include <string>
+#include <deque>
+#include <ostream>
+
+#define JOB_OUTPUT_CHUNK (4096)
+// upper bound on what one drain() takes, so a chatty job can't starve the loop
+#define JOB_OUTPUT_MAX_DRAIN (16 * JOB_OUTPUT_CHUNK)
+
+// Captured stdout/stderr of one background job. Data is kept in chunks
+// tagged with a global sequence number so that JobsList can evict the
+// oldest chunk across all jobs when the capture limit is hit.
+class OutputRing {
+public:
+    OutputRing(int fd);
+    OutputRing(const OutputRing&) = delete;
+    void operator=(const OutputRing&) = delete;
+    ~OutputRing();
+
+    int fd() const;
+    bool closed() const;
+    size_t size() const;
+    // offsets count every byte ever captured, evicted ones included
+    unsigned long long begin() const;
+    unsigned long long end() const;
+
+    // reads what the (non-blocking) pipe holds; returns the bytes added
+    size_t drain(unsigned long seq);
+    // sequence number of the oldest buffered chunk
+    unsigned long oldestSeq() const;
+    // drops up to `bytes` from the front of the oldest chunk; returns the
+    // bytes freed
+    size_t evict(size_t bytes);
+    // writes everything buffered from offset `from` on; returns end()
+    unsigned long long print(std::ostream& out, unsigned long long from) const;
+
+private:
+    struct Chunk {
+        unsigned long seq;
+        std::string data;
+    };
+    void append(const char *buf, size_t len, unsigned long seq);
+
+    std::deque<Chunk> _chunks;
+    int _fd;
+    size_t _size;
+    unsigned long long _begin;
+};
+
+#endif //SMASH_OUTPUT_RING_H_
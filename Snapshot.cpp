@@ -0,0 +1,149 @@
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "Snapshot.h"
+
+using namespace std;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int64_t rc_mtime_sec;
+    int64_t rc_mtime_nsec;
+    int64_t rc_size;
+    uint64_t rc_ino;
+    uint64_t rc_dev;
+};
+
+// followed by key_len bytes of key and value_len bytes of value
+struct SnapshotRecord {
+    uint32_t type;
+    uint32_t key_len;
+    uint32_t value_len;
+};
+
+static void _fillHeader(SnapshotHeader& header, const struct stat& rc, size_t count) {
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, RC_SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = RC_SNAPSHOT_VERSION;
+  header.count = count;
+  header.rc_mtime_sec = rc.st_mtim.tv_sec;
+  header.rc_mtime_nsec = rc.st_mtim.tv_nsec;
+  header.rc_size = rc.st_size;
+  header.rc_ino = rc.st_ino;
+  header.rc_dev = rc.st_dev;
+}
+
+/* -------------- RcState -------------- */
+
+void RcState::set(RecordType type, const std::string& key, const std::string& value) {
+    Record record = {(uint32_t)type, key, value};
+    if (type != RC_COMMAND) {
+        std::pair<uint32_t, std::string> index_key(type, key);
+        auto it = _index.find(index_key);
+        if (it != _index.end()) {
+            _records[it->second] = record;
+            return;
+        }
+        _index[index_key] = _records.size();
+    }
+    _records.push_back(record);
+}
+
+const std::vector<RcState::Record>& RcState::records() const {
+    return _records;
+}
+
+bool RcState::loadSnapshot(const std::string& path, const struct stat& rc) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const char *data = (const char *)map;
+    SnapshotHeader header, expected;
+    memcpy(&header, data, sizeof(header));
+    _fillHeader(expected, rc, header.count);
+    bool ok = memcmp(&header, &expected, sizeof(header)) == 0;
+
+    size_t off = sizeof(header);
+    for (uint32_t i = 0; ok && i < header.count; ++i) {
+        SnapshotRecord record;
+        if (size - off < sizeof(record)) {
+            ok = false;
+            break;
+        }
+        memcpy(&record, data + off, sizeof(record));
+        off += sizeof(record);
+        if (size - off < (size_t)record.key_len + record.value_len) {
+            ok = false;
+            break;
+        }
+        Record entry;
+        entry.type = record.type;
+        entry.key.assign(data + off, record.key_len);
+        entry.value.assign(data + off + record.key_len, record.value_len);
+        off += record.key_len + record.value_len;
+        if (entry.type != RC_COMMAND) {
+            _index[std::make_pair(entry.type, entry.key)] = _records.size();
+        }
+        _records.push_back(entry);
+    }
+    munmap(map, size);
+
+    if (!ok) {
+        _records.clear();
+        _index.clear();
+    }
+    return ok;
+}
+
+bool RcState::saveSnapshot(const std::string& path, const struct stat& rc) const {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    // an rc file changed within the current clock tick could change again
+    // without its mtime moving, so it is not snapshotted yet
+    if (rc.st_mtim.tv_sec > now.tv_sec ||
+        (rc.st_mtim.tv_sec == now.tv_sec && rc.st_mtim.tv_nsec >= now.tv_nsec)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    _fillHeader(header, rc, _records.size());
+    string buf((const char *)&header, sizeof(header));
+    for (const Record& entry : _records) {
+        SnapshotRecord record = {entry.type, (uint32_t)entry.key.size(), (uint32_t)entry.value.size()};
+        buf.append((const char *)&record, sizeof(record));
+        buf += entry.key;
+        buf += entry.value;
+    }
+
+    // written aside and renamed, so a reader never sees half a snapshot
+    string tmp = path + ".tmp." + to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, buf.data(), buf.size()) == (ssize_t)buf.size();
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) < 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef SMASH_SNAPSHOT_H_
+#define SMASH_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define RC_SNAPSHOT_MAGIC "SMASHRC"
+#define RC_SNAPSHOT_VERSION (3)
+
+// Shell state left behind by ~/.smashrc. It is compiled from the rc file once
+// and cached in a binary snapshot next to it, which is mmap-ed and reused for
+// as long as the rc file's mtime, size and inode are unchanged.
+class RcState {
+public:
+    enum RecordType {
+        RC_PROMPT = 1,
+        RC_ENV,
+        RC_CAPTURE,
+        RC_CAPTURE_LIMIT,
+        RC_ALIAS,
+        RC_FUNCTION,
+        // a line that is not pure state; run before the first prompt
+        RC_COMMAND,
+    };
+    struct Record {
+        uint32_t type;
+        std::string key;
+        std::string value;
+    };
+
+    // a later record of the same type and key replaces the earlier one,
+    // except for commands, which all run in order
+    void set(RecordType type, const std::string& key, const std::string& value = "");
+    const std::vector<Record>& records() const;
+
+    bool loadSnapshot(const std::string& path, const struct stat& rc);
+    bool saveSnapshot(const std::string& path, const struct stat& rc) const;
+
+private:
+    std::vector<Record> _records;
+    std::map<std::pair<uint32_t, std::string>, size_t> _index;
+};
+
+#endif //SMASH_SNAPSHOT_H_
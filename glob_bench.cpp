@@ -0,0 +1,93 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glob.h>
+#include "Glob.h"
+
+// Compares globExpand (cached directory scans) against glob(3) on a large
+// directory. usage: glob_bench [files] [rounds]
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+static double _elapsedMs(bench_clock::time_point start) {
+    return chrono::duration<double, milli>(bench_clock::now() - start).count();
+}
+
+static size_t _runGlob3(const string& pattern) {
+    glob_t g;
+    size_t n = 0;
+    if (glob(pattern.c_str(), 0, nullptr, &g) == 0) {
+        n = g.gl_pathc;
+    }
+    globfree(&g);
+    return n;
+}
+
+static size_t _runGlobExpand(const string& pattern) {
+    vector<string> matches;
+    return globExpand(pattern, matches);
+}
+
+int main(int argc, char* argv[]) {
+    int files = argc > 1 ? atoi(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+    char dir[] = "/tmp/smash_glob_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char name[256];
+    for (int i = 0; i < files; ++i) {
+        snprintf(name, sizeof(name), "%s/job-%06d.%s", dir, i, i % 4 ? "log" : "txt");
+        int fd = open(name, O_WRONLY | O_CREAT, 0644);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    const string patterns[] = {
+        string(dir) + "/*.log",
+        string(dir) + "/job-00[0-4]??[13579].*",
+        string(dir) + "/job-09999?.txt",
+    };
+    cout << "glob bench: " << files << " files, " << rounds << " rounds" << endl;
+    for (const string& pattern : patterns) {
+        size_t n3 = 0, ne = 0;
+        bench_clock::time_point start = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            n3 = _runGlob3(pattern);
+        }
+        double glob3_ms = _elapsedMs(start) / rounds;
+
+        // every pattern lists the same directory; start each one uncached
+        DirCache::getInstance().clear();
+        start = bench_clock::now();
+        ne = _runGlobExpand(pattern);
+        double cold_ms = _elapsedMs(start);
+        start = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            ne = _runGlobExpand(pattern);
+        }
+        double warm_ms = _elapsedMs(start) / rounds;
+
+        cout << pattern.substr(sizeof(dir)) << ": " << n3 << "/" << ne << " matches"
+             << " glob(3) " << glob3_ms << " ms"
+             << ", globExpand cold " << cold_ms << " ms"
+             << ", cached " << warm_ms << " ms" << endl;
+    }
+
+    for (int i = 0; i < files; ++i) {
+        snprintf(name, sizeof(name), "%s/job-%06d.%s", dir, i, i % 4 ? "log" : "txt");
+        unlink(name);
+    }
+    rmdir(dir);
+    return 0;
+}
@@ -15,15 +15,21 @@ int main(int argc, char* argv[]) {
     if (signal(SIGCHLD , sigchld_handler) == SIG_ERR) {
         perror("smash error: failed to set ctrl-Z handler");
     }
+    // smash hands the terminal to foreground jobs and takes it back
+    if (signal(SIGTTOU , SIG_IGN) == SIG_ERR) {
+        perror("smash error: failed to ignore SIGTTOU");
+    }
     // if(signal(SIGINT , ctrlCHandler)==SIG_ERR) {
     //     perror("smash error: failed to set ctrl-C handler");
     // }
 
     SmallShell& smash = SmallShell::getInstance();
+    if (!smash.runRcCommands()) {
+        return 0;
+    }
     string cmd_line;
     do {
-        cout << smash.name();
-        getline(std::cin, cmd_line);
-    } while (smash.executeCommand(cmd_line.c_str()));
-    return 1;
+        cout << smash.name() << flush;
+    } while (smash.readLine(cmd_line) && smash.executeCommand(cmd_line.c_str()));
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Measures the time from exec of smash to its first prompt, once with the
+// ~/.smashrc snapshot removed before every run (cold) and once reusing it.
+// usage: startup_bench [smash] [rc lines] [rounds]
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+static const char *PROMPT = "bench> ";
+
+static double _bootMs(const string& smash, const string& home) {
+    int in[2], out[2];
+    if (pipe(in) < 0 || pipe(out) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    bench_clock::time_point start = bench_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        setenv("HOME", home.c_str(), 1);
+        execl(smash.c_str(), smash.c_str(), (char *)nullptr);
+        perror("execl");
+        _exit(1);
+    }
+    close(in[0]);
+    close(out[1]);
+
+    string seen;
+    char buf[256];
+    double ms = -1;
+    while (seen.find(PROMPT) == string::npos) {
+        ssize_t n = read(out[0], buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        seen.append(buf, n);
+    }
+    if (seen.find(PROMPT) != string::npos) {
+        ms = chrono::duration<double, milli>(bench_clock::now() - start).count();
+    }
+    if (write(in[1], "quit\n", 5) < 0) {
+        perror("write");
+    }
+    close(in[1]);
+    close(out[0]);
+    waitpid(pid, nullptr, 0);
+    return ms;
+}
+
+static void _report(const char *mode, vector<double>& samples) {
+    sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double ms : samples) {
+        sum += ms;
+    }
+    cout << mode << ": mean " << sum / samples.size() << " ms, median "
+         << samples[samples.size() / 2] << " ms, min " << samples[0] << " ms" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string smash = argc > 1 ? argv[1] : "./smash";
+    int lines = argc > 2 ? atoi(argv[2]) : 2000;
+    int rounds = argc > 3 ? atoi(argv[3]) : 50;
+
+    char home[] = "/tmp/smash_startup_bench.XXXXXX";
+    if (!mkdtemp(home)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    string rc = string(home) + "/.smashrc";
+    string snapshot = rc + ".snap";
+    {
+        ofstream out(rc.c_str());
+        out << "chprompt bench" << endl;
+        out << "joblog -m 2097152" << endl;
+        for (int i = 0; i < lines; ++i) {
+            out << "export SMASH_BENCH_" << i << "=value_" << i << endl;
+        }
+    }
+    // the snapshot is only written once the rc file is older than a clock tick
+    sleep(1);
+
+    vector<double> cold, warm;
+    for (int r = 0; r < rounds; ++r) {
+        unlink(snapshot.c_str());
+        cold.push_back(_bootMs(smash, home));
+    }
+    _bootMs(smash, home);
+    for (int r = 0; r < rounds; ++r) {
+        warm.push_back(_bootMs(smash, home));
+    }
+
+    cout << "startup bench: " << lines << " rc lines, " << rounds << " rounds" << endl;
+    _report("cold", cold);
+    _report("snapshot", warm);
+
+    unlink(snapshot.c_str());
+    unlink(rc.c_str());
+    rmdir(home);
+    return 0;
+}